@@ -1,5 +1,8 @@
 #include "libdragon.h"
+#include "usb.h"
 #include <math.h>
+#include "physics.h"
+#include "spectator.h"
 
 static sprite_t *background_sprite;
 static sprite_t *brew_sprite;
@@ -23,33 +26,15 @@ typedef struct {
     float length;
 } collision_t;
 
-typedef struct {
-    float x;
-    float y;
-    float dx;
-    float dy;
-    float scale_factor; // TODO support separate x/y scale factors? support rotation?
-} object_t;
-
 #define NUM_BLOBS 2
 #define INITIAL_COUNTDOWN 3
 #define MAX_POINTS 21
 
-#define FRAMERATE 60
-#define AIR_FRICTION_FACTOR 0.99f
-#define GROUND_FRICTION_FACTOR 0.9f
-#define GRAVITY_FACTOR 9.81f
-#define SPEED_EPSILON 1e-1
-#define POSITION_EPSILON 10
-
 static object_t blobs[NUM_BLOBS];
 static object_t ball;
 static object_t net;
 
-static int32_t obj_min_x;
-static int32_t obj_max_x;
-static int32_t obj_min_y;
-static int32_t obj_max_y;
+static physics_t physics;
 static int32_t cur_tick = 0;
 
 // DEBUG collisions
@@ -69,12 +54,21 @@ uint32_t startTime = 0;
 #define CHANNEL_SFX3    2
 #define CHANNEL_MUSIC   3
 
+// Spectator stream, filled by update() and flushed from the main loop
+_Static_assert(NUM_BLOBS == SPECTATOR_NUM_BLOBS, "spectator stream must carry every blob");
+static spectator_stream_t spectator;
+
+static void usb_sink_write(void *ctx, const uint8_t *data, size_t len) {
+    usb_write(DATATYPE_RAWBINARY, data, len);
+}
+
+static const spectator_sink_t spectator_sink = { usb_sink_write, NULL };
 
 void init_player(uint32_t i) {
     uint32_t display_width = display_get_width();
     object_t* obj = &blobs[i];
     obj->x = i == 0 ? 40 : display_width - brew_sprite->width - 40;
-    obj->y = obj_max_y - brew_sprite->height;
+    obj->y = physics.max_y - brew_sprite->height;
     obj->dx = 0;
     obj->dy = 0;
     obj->scale_factor = 1.0f;
@@ -114,77 +108,6 @@ collision_t circleRect(float cx, float cy, float radius, float rx, float ry, flo
   return retval;
 }
 
-void applyScreenLimits(float x, float y, float w, float h, float dx, float dy, object_t* obj) {
-    float next_x = x + dx;
-    float next_y = y + dy;
-
-    if (next_x + w >= obj_max_x) {
-        next_x = obj_max_x - (next_x + w - obj_max_x) - w;
-        obj->dx = -1.0 * dx;
-        ////fprintf(stderr, "X position %f >= %ld --> BOUNCE TO %f, dx=%f\n", next_x + w, obj_max_x, next_x, obj->dx);
-    }
-    if (next_x < obj_min_x) {
-        next_x = obj_min_x + (obj_min_x - next_x);
-        obj->dx = -1.0 * dx;
-        ////fprintf(stderr, "X position %f < %ld --> BOUNCE TO %f, dx=%f\n", next_x, obj_min_x, next_x, obj->dx);
-    }
-    if (next_y + h >= obj_max_y) {
-        next_y = obj_max_y - (next_y + h - obj_max_y) - h;
-        obj->dy = -1.0 * dy / 2;
-        ////fprintf(stderr, "Y position %f >= %ld --> BOUNCE TO %f, dy=%f\n", next_y + h, obj_max_y, next_y, obj->dy);
-    }
-    if (next_y < obj_min_y) {
-        next_y = obj_min_y + (obj_min_x - next_y);
-        obj->dy = -1.0 * dy;
-        ////fprintf(stderr, "Y position %f < %ld --> BOUNCE TO %f, dy=%f\n", next_y, obj_min_y, next_y, obj->dy);
-    }
-    
-    obj->x = next_x;
-    obj->y = next_y;
-}
-
-void applyScreenLimitsRect(object_t* obj, sprite_t* sprite) {
-    applyScreenLimits(obj->x, obj->y, sprite->width, sprite->height, obj->dx, obj->dy, obj);
-}
-
-void applyScreenLimitsCircle(object_t* obj, sprite_t* sprite) {
-    applyScreenLimits(obj->x - sprite->width/2, obj->y - sprite->height/2, sprite->width, sprite->height, obj->dx, obj->dy, obj);
-    obj->x += sprite->width/2;
-    obj->y += sprite->height/2;
-}
-
-void applyFriction(object_t* obj) {
-    if (obj->dx != 0) {
-        if (fabs(obj->dx) < SPEED_EPSILON) {
-            //fprintf(stderr, "dx < %f --> 0\n", SPEED_EPSILON);
-            obj->dx = 0;
-        } else {
-            float factor = (obj->y < obj_max_y) ? AIR_FRICTION_FACTOR : GROUND_FRICTION_FACTOR;
-            ////fprintf(stderr, "applying friction...\n");
-            float next_dx = fabs(obj->dx) * factor;
-            ////fprintf(stderr, "blob[%ld]: next_dx=%f obj->dx=%f/%f\n", i, next_dx, -1.0f * next_dx, next_dx);
-            ////fprintf(stderr, "blob[%ld]: x=%f dx=%f fabs(dx)=%f next_dx=%f\n", i, obj->x, obj->dx, fabs(obj->dx), (obj->dx < 0) ? (-1.0f * next_dx) : next_dx);
-            if (obj->dx < 0) {
-                obj->dx = -1.0f * next_dx;
-            } else {
-                obj->dx = next_dx;
-            }
-        }
-    }
-}
-
-void applyGravity(object_t* obj) {
-    if (obj->dy > 0 && obj->dy < SPEED_EPSILON && (obj_max_y - fabs(obj->y)) < POSITION_EPSILON) {
-        //fprintf(stderr, "dy < %f --> 0\n", SPEED_EPSILON);
-        obj->dy = 0;
-        obj->y = obj_max_y;
-    } else if (obj->y < obj_max_y - ball_sprite->height) {
-        float next_dy = obj->dy + (GRAVITY_FACTOR / FRAMERATE);
-        ////fprintf(stderr, "blob[%ld]: y=%f dy=%f fabs(dy)=%f next_dy=%f\n", i, obj->y, obj->dy, fabs(obj->dy), next_dy);
-        obj->dy = next_dy;
-    }
-}
-
 int get_winner() {
     return (scorePlayer1 >= MAX_POINTS && (scorePlayer1 - scorePlayer2) > 1)
         ? 1
@@ -197,6 +120,27 @@ bool in_play() {
     return countdown == 0 && !get_winner();
 }
 
+static void copy_spectator_object(spectator_object_t* dst, const object_t* src) {
+    dst->x = src->x;
+    dst->y = src->y;
+    dst->dx = src->dx;
+    dst->dy = src->dy;
+}
+
+void broadcast_state() {
+    spectator_state_t state = {0};
+    for (uint32_t i = 0; i < NUM_BLOBS; i++) {
+        copy_spectator_object(&state.blobs[i], &blobs[i]);
+    }
+    copy_spectator_object(&state.ball, &ball);
+    state.score1 = scorePlayer1;
+    state.score2 = scorePlayer2;
+    state.countdown = countdown;
+    state.last_player = lastPlayer;
+    state.hit_count = hitCount;
+    spectator_push(&spectator, &state);
+}
+
 /*void update_countdown(int ovfl);
 
 void start_countdown() {
@@ -232,12 +176,13 @@ void update(int ovfl)
             countdown = INITIAL_COUNTDOWN;
             startTime = get_ticks_ms();
         }
+        broadcast_state();
         return;
     }
 
     // Ball
     // Ball hits ground ???
-    if (ball.y + ball.dy + ball_sprite->height/2 >= obj_max_y) {
+    if (ball.y + ball.dy * physics.dt + ball_sprite->height/2 >= physics.max_y) {
         // Sound FX
         wav64_play(&sfx_halt, CHANNEL_SFX2);
         uint32_t display_width = display_get_width();
@@ -249,7 +194,7 @@ void update(int ovfl)
             scorePlayer2++;
             ball.x = 3.0 * (display_width / 4.0f);
         }
-        ball.y = obj_min_y + ball_sprite->height/2;
+        ball.y = physics.min_y + ball_sprite->height/2;
         ball.dx = 0;
         ball.dy = 0;
         hitCount = 0;
@@ -272,10 +217,10 @@ void update(int ovfl)
     }
 
     ////fprintf(stderr, "Applying screen limits BALL\n");
-    applyScreenLimitsCircle(&ball, ball_sprite);
+    applyScreenLimitsCircle(&physics, &ball, ball_sprite->width, ball_sprite->height);
     // TODO also air friction? magnus effect?
-    applyFriction(&ball);
-    applyGravity(&ball);
+    applyFriction(&physics, &ball);
+    applyGravity(&physics, &ball, ball_sprite->height);
 
     // TODO Handle collision with net
     collision_t netCollision = circleRect(ball.x, ball.y, ball_sprite->width/2, net.x, net.y, net_sprite->width, net_sprite->height);
@@ -347,14 +292,14 @@ void update(int ovfl)
         ////fprintf(stderr, "blob[%ld]: x=%ld y=%ld dx=%f dy=%f\n", i, obj->x, obj->y, obj->dx, obj->dy);
 
         ////fprintf(stderr, "Applying screen limits PLAYER %ld\n", i);
-        applyScreenLimitsRect(obj, brew_sprite); // FIXME Handle with collisions to be resolved all at once ?
+        applyScreenLimitsRect(&physics, obj, brew_sprite->width, brew_sprite->height); // FIXME Handle with collisions to be resolved all at once ?
 
         ////fprintf(stderr, "blob[%ld]: x=%ld y=%ld dx=%f dy=%f\n", i, obj->x, obj->y, obj->dx, obj->dy);
         ////fprintf(stderr, "blob[%ld]: fabs(dx)=%f\n", i, fabs(obj->dx));
 
         // Apply gravity / friction
-        applyFriction(obj);
-        applyGravity(obj);
+        applyFriction(&physics, obj);
+        applyGravity(&physics, obj, ball_sprite->height);
 
         // TODO Handle collisions
             // Player / Net (bounce / block)
@@ -469,6 +414,7 @@ void update(int ovfl)
     }
 
     cur_tick++;
+    broadcast_state();
 }
 
 void render(int cur_frame)
@@ -613,10 +559,7 @@ int main()
 
     brew_sprite = sprite_load("rom:/n64brew.sprite");
 
-    obj_min_x = 5;
-    obj_max_x = display_width - 5;
-    obj_min_y = 5;
-    obj_max_y = display_height - 15;
+    physics_init(&physics, PHYSICS_DT, 5, display_width - 5, 5, display_height - 15);
 
     for (uint32_t i = 0; i < NUM_BLOBS; i++)
     {
@@ -630,7 +573,7 @@ int main()
 
     ball_sprite = sprite_load("rom:/ball.sprite");
     ball.x = display_width / 4.0f;
-    ball.y = obj_min_y + ball_sprite->height/2;
+    ball.y = physics.min_y + ball_sprite->height/2;
     ball.dx = 0;
     ball.dy = 0;
     ball.scale_factor = 1.0f;
@@ -646,8 +589,9 @@ int main()
     //start_countdown();
     startTime = get_ticks_ms();
 
+    spectator_stream_init(&spectator);
     update(0);
-    new_timer(TIMER_TICKS(1000000 / FRAMERATE), TF_CONTINUOUS, update);
+    new_timer(TIMER_TICKS(1000000 / PHYSICS_RATE), TF_CONTINUOUS, update);
 
     //fprintf(stderr, "Entering main loop\n");
 
@@ -658,6 +602,7 @@ int main()
     while (1)
     {
         render(cur_frame);
+        spectator_flush(&spectator, &spectator_sink);
 
         controller_scan();
         struct controller_data pressed = get_keys_pressed();
@@ -667,16 +612,16 @@ int main()
             {
                 if ((i == 0 && (controllers & CONTROLLER_1_INSERTED)) || (i == 1 && (controllers & CONTROLLER_2_INSERTED))) {
                     object_t *obj = &blobs[i];
-                    if ((pressed.c[i].up || pressed.c[i].A || pressed.c[i].B) && (obj_max_y - fabs(obj->y) - brew_sprite->height) < POSITION_EPSILON) {
-                        obj->dy = -6;
+                    if ((pressed.c[i].up || pressed.c[i].A || pressed.c[i].B) && (physics.max_y - fabs(obj->y) - brew_sprite->height) < POSITION_EPSILON) {
+                        obj->dy = -JUMP_SPEED;
                     }
 
                     if (pressed.c[i].left) {
-                        obj->dx = -6;
+                        obj->dx = -MOVE_SPEED;
                     }
 
                     if (pressed.c[i].right) {
-                        obj->dx = 6;
+                        obj->dx = MOVE_SPEED;
                     }
 
                     /*if (fabs(pressed.c[i].x) > 5) {
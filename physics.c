@@ -0,0 +1,73 @@
+#include "physics.h"
+#include <math.h>
+
+void physics_init(physics_t* physics, float dt, int32_t min_x, int32_t max_x, int32_t min_y, int32_t max_y) {
+    physics->min_x = min_x;
+    physics->max_x = max_x;
+    physics->min_y = min_y;
+    physics->max_y = max_y;
+    physics->dt = dt;
+    // Friction factors are per reference tick: decay exponentially over dt
+    physics->air_friction = powf(AIR_FRICTION_FACTOR, dt * REFERENCE_RATE);
+    physics->ground_friction = powf(GROUND_FRICTION_FACTOR, dt * REFERENCE_RATE);
+}
+
+void applyScreenLimits(const physics_t* physics, float x, float y, float w, float h, float dx, float dy, object_t* obj) {
+    float next_x = x + dx * physics->dt;
+    float next_y = y + dy * physics->dt;
+
+    if (next_x + w >= physics->max_x) {
+        next_x = physics->max_x - (next_x + w - physics->max_x) - w;
+        obj->dx = -1.0 * dx;
+    }
+    if (next_x < physics->min_x) {
+        next_x = physics->min_x + (physics->min_x - next_x);
+        obj->dx = -1.0 * dx;
+    }
+    if (next_y + h >= physics->max_y) {
+        next_y = physics->max_y - (next_y + h - physics->max_y) - h;
+        obj->dy = -1.0 * dy / 2;
+    }
+    if (next_y < physics->min_y) {
+        next_y = physics->min_y + (physics->min_x - next_y);
+        obj->dy = -1.0 * dy;
+    }
+
+    obj->x = next_x;
+    obj->y = next_y;
+}
+
+void applyScreenLimitsRect(const physics_t* physics, object_t* obj, float w, float h) {
+    applyScreenLimits(physics, obj->x, obj->y, w, h, obj->dx, obj->dy, obj);
+}
+
+void applyScreenLimitsCircle(const physics_t* physics, object_t* obj, float w, float h) {
+    applyScreenLimits(physics, obj->x - w/2, obj->y - h/2, w, h, obj->dx, obj->dy, obj);
+    obj->x += w/2;
+    obj->y += h/2;
+}
+
+void applyFriction(const physics_t* physics, object_t* obj) {
+    if (obj->dx != 0) {
+        if (fabs(obj->dx) < SPEED_EPSILON) {
+            obj->dx = 0;
+        } else {
+            float factor = (obj->y < physics->max_y) ? physics->air_friction : physics->ground_friction;
+            float next_dx = fabs(obj->dx) * factor;
+            if (obj->dx < 0) {
+                obj->dx = -1.0f * next_dx;
+            } else {
+                obj->dx = next_dx;
+            }
+        }
+    }
+}
+
+void applyGravity(const physics_t* physics, object_t* obj, float h) {
+    if (obj->dy > 0 && obj->dy < SPEED_EPSILON && (physics->max_y - fabs(obj->y)) < POSITION_EPSILON) {
+        obj->dy = 0;
+        obj->y = physics->max_y;
+    } else if (obj->y < physics->max_y - h) {
+        obj->dy += GRAVITY * physics->dt;
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+#include <stdint.h>
+
+// Physics runs at PHYSICS_RATE, independently of the display rate.
+// Tuning constants below are expressed per tick at REFERENCE_RATE, the rate
+// the game was originally tuned for, and scaled to seconds from there.
+#define PHYSICS_RATE 60
+#define PHYSICS_DT (1.0f / PHYSICS_RATE)
+#define REFERENCE_RATE 60.0f
+#define AIR_FRICTION_FACTOR 0.99f
+#define GROUND_FRICTION_FACTOR 0.9f
+#define GRAVITY_FACTOR 9.81f
+#define GRAVITY (GRAVITY_FACTOR * REFERENCE_RATE)   // px/s^2
+#define MOVE_SPEED (6 * REFERENCE_RATE)             // px/s
+#define JUMP_SPEED (6 * REFERENCE_RATE)             // px/s
+#define SPEED_EPSILON (1e-1 * REFERENCE_RATE)       // px/s
+#define POSITION_EPSILON 10
+
+typedef struct {
+    float x;
+    float y;
+    float dx;   // px/s
+    float dy;   // px/s
+    float scale_factor; // TODO support separate x/y scale factors? support rotation?
+} object_t;
+
+typedef struct {
+    // Screen limits
+    int32_t min_x;
+    int32_t max_x;
+    int32_t min_y;
+    int32_t max_y;
+    // Step duration (s) and the matching per-step friction factors
+    float dt;
+    float air_friction;
+    float ground_friction;
+} physics_t;
+
+void physics_init(physics_t* physics, float dt, int32_t min_x, int32_t max_x, int32_t min_y, int32_t max_y);
+
+void applyScreenLimits(const physics_t* physics, float x, float y, float w, float h, float dx, float dy, object_t* obj);
+void applyScreenLimitsRect(const physics_t* physics, object_t* obj, float w, float h);
+void applyScreenLimitsCircle(const physics_t* physics, object_t* obj, float w, float h);
+void applyFriction(const physics_t* physics, object_t* obj);
+// Objects whose y is more than h above the ground fall
+void applyGravity(const physics_t* physics, object_t* obj, float h);
+
+#endif
@@ -0,0 +1,209 @@
+#include "spectator.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static int16_t quantize(float value, float scale) {
+    float q = roundf(value * scale);
+    if (q > INT16_MAX) return INT16_MAX;
+    if (q < INT16_MIN) return INT16_MIN;
+    return (int16_t) q;
+}
+
+static void pack_object(int16_t *fields, const spectator_object_t *obj) {
+    fields[0] = quantize(obj->x, SPECTATOR_POS_SCALE);
+    fields[1] = quantize(obj->y, SPECTATOR_POS_SCALE);
+    fields[2] = quantize(obj->dx, SPECTATOR_VEL_SCALE);
+    fields[3] = quantize(obj->dy, SPECTATOR_VEL_SCALE);
+}
+
+static void unpack_object(const int16_t *fields, spectator_object_t *obj) {
+    obj->x = fields[0] / SPECTATOR_POS_SCALE;
+    obj->y = fields[1] / SPECTATOR_POS_SCALE;
+    obj->dx = fields[2] / SPECTATOR_VEL_SCALE;
+    obj->dy = fields[3] / SPECTATOR_VEL_SCALE;
+}
+
+static void pack_state(int16_t *fields, const spectator_state_t *state) {
+    for (int i = 0; i < SPECTATOR_NUM_BLOBS; i++) {
+        pack_object(&fields[4 * i], &state->blobs[i]);
+    }
+    int16_t *f = &fields[4 * SPECTATOR_NUM_BLOBS];
+    pack_object(f, &state->ball);
+    f[4] = state->score1;
+    f[5] = state->score2;
+    f[6] = state->countdown;
+    f[7] = state->last_player;
+    f[8] = state->hit_count;
+}
+
+static void unpack_state(const int16_t *fields, spectator_state_t *state) {
+    for (int i = 0; i < SPECTATOR_NUM_BLOBS; i++) {
+        unpack_object(&fields[4 * i], &state->blobs[i]);
+    }
+    const int16_t *f = &fields[4 * SPECTATOR_NUM_BLOBS];
+    unpack_object(f, &state->ball);
+    state->score1 = f[4];
+    state->score2 = f[5];
+    state->countdown = f[6];
+    state->last_player = f[7];
+    state->hit_count = f[8];
+}
+
+static uint8_t *write_varint(uint8_t *p, int32_t value) {
+    uint32_t zz = ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+    while (zz >= 0x80) {
+        *p++ = (zz & 0x7F) | 0x80;
+        zz >>= 7;
+    }
+    *p++ = zz;
+    return p;
+}
+
+static const uint8_t *read_varint(const uint8_t *p, const uint8_t *end, int32_t *value) {
+    uint32_t zz = 0;
+    for (int shift = 0; shift < 32; shift += 7) {
+        if (p >= end) return NULL;
+        uint8_t b = *p++;
+        zz |= (uint32_t) (b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *value = (int32_t) (zz >> 1) ^ -(int32_t) (zz & 1);
+            return p;
+        }
+    }
+    return NULL;
+}
+
+void spectator_encoder_init(spectator_encoder_t *enc) {
+    memset(enc, 0, sizeof(*enc));
+    enc->force_key = true;
+}
+
+size_t spectator_encode(spectator_encoder_t *enc, const spectator_state_t *state, uint8_t *out) {
+    int16_t fields[SPECTATOR_NUM_FIELDS];
+    pack_state(fields, state);
+
+    bool keyframe = enc->force_key || enc->since_key >= SPECTATOR_KEYFRAME_INTERVAL;
+    if (keyframe) {
+        memcpy(enc->key, fields, sizeof(fields));
+        enc->key_id++;
+        enc->since_key = 0;
+        enc->force_key = false;
+    }
+    enc->since_key++;
+
+    uint8_t *p = out + 1;
+    *p++ = keyframe ? SPECTATOR_FLAG_KEYFRAME : 0;
+    *p++ = enc->seq & 0xFF;
+    *p++ = enc->seq >> 8;
+    *p++ = enc->key_id;
+    enc->seq++;
+
+    if (keyframe) {
+        for (int i = 0; i < SPECTATOR_NUM_FIELDS; i++) {
+            *p++ = (uint16_t) fields[i] & 0xFF;
+            *p++ = (uint16_t) fields[i] >> 8;
+        }
+    } else {
+        uint32_t mask = 0;
+        for (int i = 0; i < SPECTATOR_NUM_FIELDS; i++) {
+            if (fields[i] != enc->key[i]) mask |= 1 << i;
+        }
+        *p++ = mask & 0xFF;
+        *p++ = (mask >> 8) & 0xFF;
+        *p++ = (mask >> 16) & 0xFF;
+        for (int i = 0; i < SPECTATOR_NUM_FIELDS; i++) {
+            if (mask & (1 << i)) p = write_varint(p, (int32_t) fields[i] - enc->key[i]);
+        }
+    }
+
+    out[0] = p - out - 1;
+    return p - out;
+}
+
+void spectator_decoder_init(spectator_decoder_t *dec) {
+    memset(dec, 0, sizeof(*dec));
+}
+
+bool spectator_decode(spectator_decoder_t *dec, const uint8_t *packet, size_t len, spectator_state_t *state) {
+    const uint8_t *p = packet;
+    const uint8_t *end = packet + len;
+    if (len < 4) return false;
+    uint8_t flags = *p++;
+    uint16_t seq = p[0] | (p[1] << 8);
+    p += 2;
+    uint8_t key_id = *p++;
+
+    int16_t fields[SPECTATOR_NUM_FIELDS];
+    if (flags & SPECTATOR_FLAG_KEYFRAME) {
+        if (end - p < 2 * SPECTATOR_NUM_FIELDS) return false;
+        for (int i = 0; i < SPECTATOR_NUM_FIELDS; i++, p += 2) {
+            fields[i] = (int16_t) (p[0] | (p[1] << 8));
+        }
+    } else {
+        if (!dec->has_key || dec->key_id != key_id) return false;
+        if (end - p < 3) return false;
+        uint32_t mask = p[0] | (p[1] << 8) | ((uint32_t) p[2] << 16);
+        p += 3;
+        for (int i = 0; i < SPECTATOR_NUM_FIELDS; i++) {
+            int32_t diff = 0;
+            if (mask & (1 << i)) {
+                p = read_varint(p, end, &diff);
+                if (p == NULL) return false;
+            }
+            fields[i] = dec->key[i] + diff;
+        }
+    }
+    if (p != end) return false;
+
+    if (flags & SPECTATOR_FLAG_KEYFRAME) {
+        memcpy(dec->key, fields, sizeof(fields));
+        dec->key_id = key_id;
+        dec->has_key = true;
+    }
+    state->seq = seq;
+    unpack_state(fields, state);
+    return true;
+}
+
+void spectator_stream_init(spectator_stream_t *stream) {
+    spectator_encoder_init(&stream->encoder);
+    stream->head = 0;
+    stream->tail = 0;
+    stream->dropped = 0;
+}
+
+void spectator_push(spectator_stream_t *stream, const spectator_state_t *state) {
+    uint8_t packet[SPECTATOR_MAX_PACKET];
+    size_t len = spectator_encode(&stream->encoder, state, packet);
+
+    uint32_t head = stream->head;
+    uint32_t used = head - stream->tail;
+    if (SPECTATOR_BUFFER_SIZE - used < len) {
+        // Sink is lagging: drop this tick and resync with a keyframe
+        stream->dropped++;
+        stream->encoder.force_key = true;
+        return;
+    }
+    for (size_t i = 0; i < len; i++) {
+        stream->buffer[(head + i) % SPECTATOR_BUFFER_SIZE] = packet[i];
+    }
+    stream->head = head + len;
+}
+
+void spectator_flush(spectator_stream_t *stream, const spectator_sink_t *sink) {
+    uint32_t head = stream->head;
+    uint32_t tail = stream->tail;
+    while (tail != head) {
+        uint32_t start = tail % SPECTATOR_BUFFER_SIZE;
+        uint32_t count = head - tail;
+        if (start + count > SPECTATOR_BUFFER_SIZE) count = SPECTATOR_BUFFER_SIZE - start;
+        sink->write(sink->ctx, &stream->buffer[start], count);
+        tail += count;
+    }
+    stream->tail = tail;
+}
+
+void spectator_file_write(void *ctx, const uint8_t *data, size_t len) {
+    fwrite(data, 1, len, (FILE *) ctx);
+}
@@ -0,0 +1,98 @@
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Spectator stream: the game state is quantized every tick and sent as a
+// delta against the last keyframe, with a full keyframe every
+// SPECTATOR_KEYFRAME_INTERVAL ticks. Each packet is prefixed by its length
+// so that the stream can be concatenated in a file and decoded on the host.
+//
+// The sinks are one-way, so there are no acknowledgements: deltas reference
+// the last keyframe *sent*. If a keyframe is lost, the following deltas (up
+// to SPECTATOR_KEYFRAME_INTERVAL ticks) cannot be decoded until the next one.
+//
+// Packet layout (after the length byte):
+//   flags (1) | seq (2, LE) | keyframe id (1) | payload
+// Keyframe payload: every field as int16 LE.
+// Delta payload: 24-bit mask of changed fields, then one zigzag varint per
+// changed field holding the difference with the referenced keyframe.
+
+#define SPECTATOR_NUM_BLOBS 2
+#define SPECTATOR_NUM_FIELDS (4 * (SPECTATOR_NUM_BLOBS + 1) + 5)
+#define SPECTATOR_KEYFRAME_INTERVAL 60
+#define SPECTATOR_MAX_PACKET 64
+#define SPECTATOR_BUFFER_SIZE 2048
+
+#define SPECTATOR_POS_SCALE 4.0f    // 1/4 pixel
+#define SPECTATOR_VEL_SCALE 2.0f    // 1/2 pixel per second
+
+#define SPECTATOR_FLAG_KEYFRAME 0x01
+
+typedef struct {
+    float x;
+    float y;
+    float dx;
+    float dy;
+} spectator_object_t;
+
+typedef struct {
+    uint16_t seq;   // Output only: set by spectator_decode(), ignored by the encoder
+    spectator_object_t blobs[SPECTATOR_NUM_BLOBS];
+    spectator_object_t ball;
+    int score1;
+    int score2;
+    int countdown;
+    int last_player;
+    int hit_count;
+} spectator_state_t;
+
+typedef struct {
+    int16_t key[SPECTATOR_NUM_FIELDS];
+    uint8_t key_id;
+    uint16_t seq;
+    uint32_t since_key;
+    bool force_key;
+} spectator_encoder_t;
+
+typedef struct {
+    int16_t key[SPECTATOR_NUM_FIELDS];
+    uint8_t key_id;
+    bool has_key;
+} spectator_decoder_t;
+
+typedef void (*spectator_write_fn)(void *ctx, const uint8_t *data, size_t len);
+
+typedef struct {
+    spectator_write_fn write;
+    void *ctx;
+} spectator_sink_t;
+
+// Single producer (timer interrupt) / single consumer (main loop) byte ring.
+typedef struct {
+    spectator_encoder_t encoder;
+    uint8_t buffer[SPECTATOR_BUFFER_SIZE];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint32_t dropped;
+} spectator_stream_t;
+
+void spectator_encoder_init(spectator_encoder_t *enc);
+// Encodes a framed packet (length byte included) into out, returns its size.
+size_t spectator_encode(spectator_encoder_t *enc, const spectator_state_t *state, uint8_t *out);
+
+void spectator_decoder_init(spectator_decoder_t *dec);
+// Decodes one packet (without its length byte). Returns false if the packet
+// is malformed or references a keyframe that was not received.
+bool spectator_decode(spectator_decoder_t *dec, const uint8_t *packet, size_t len, spectator_state_t *state);
+
+void spectator_stream_init(spectator_stream_t *stream);
+void spectator_push(spectator_stream_t *stream, const spectator_state_t *state);
+void spectator_flush(spectator_stream_t *stream, const spectator_sink_t *sink);
+
+// Sink writing to a FILE* passed as ctx
+void spectator_file_write(void *ctx, const uint8_t *data, size_t len);
+
+#endif
@@ -0,0 +1,151 @@
+// Convergence test for the physics integrator: a player jump, a ball hit and
+// a small object settling on the floor are simulated at 30, 60 and 120 Hz and
+// compared with a much finer 960 Hz reference. Every run bounces off a wall,
+// lands on the floor and slows down until the speed cutoff stops it. Fails if
+// the RMS error does not roughly halve each time the rate doubles.
+
+#include "physics.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define SCREEN_WIDTH 640
+#define SCREEN_HEIGHT 480
+#define BLOB_WIDTH 64
+#define BLOB_HEIGHT 96
+#define BALL_SIZE 64
+#define PEBBLE_SIZE 4
+#define SAMPLE_RATE 30
+#define NUM_SAMPLES (8 * SAMPLE_RATE)   // 8 seconds
+#define REFERENCE_SIM_RATE 960
+#define NUM_RATES 3
+#define MIN_RATIO 1.6f
+#define MAX_RATIO 2.6f
+
+static const int rates[NUM_RATES] = { 30, 60, 120 };
+
+typedef struct {
+    float x[NUM_SAMPLES];
+    float y[NUM_SAMPLES];
+    int wall_bounces;
+    int floor_bounces;
+    bool stopped;
+    bool rested;
+} trajectory_t;
+
+typedef struct {
+    const char* name;
+    object_t start;
+    bool circle;
+    float w;
+    float h;
+    float gravity_h;
+    // The rest snap moves the object by up to POSITION_EPSILON at once, so
+    // only a decreasing error is expected when it comes to rest
+    bool rests;
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+    // Player running into the right wall while jumping
+    { "jump", { SCREEN_WIDTH - BLOB_WIDTH - 40, SCREEN_HEIGHT - 15 - BLOB_HEIGHT, MOVE_SPEED, -JUMP_SPEED, 1.0f },
+      false, BLOB_WIDTH, BLOB_HEIGHT, BALL_SIZE, false },
+    // Ball hit up towards the right wall, then bouncing on the floor
+    { "ball", { 400, 200, 500, -300, 1.0f },
+      true, BALL_SIZE, BALL_SIZE, BALL_SIZE, false },
+    // Small object thrown at the left wall, bouncing until it comes to rest
+    { "settle", { 100, 300, -400, -200, 1.0f },
+      false, PEBBLE_SIZE, PEBBLE_SIZE, PEBBLE_SIZE, true },
+};
+
+// Same sequence as update() in main.c
+static void simulate(const scenario_t* scenario, int rate, trajectory_t* out)
+{
+    physics_t physics;
+    physics_init(&physics, 1.0f / rate, 5, SCREEN_WIDTH - 5, 5, SCREEN_HEIGHT - 15);
+    object_t obj = scenario->start;
+    out->wall_bounces = 0;
+    out->floor_bounces = 0;
+    out->stopped = false;
+    out->rested = false;
+
+    int steps = rate / SAMPLE_RATE;
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        for (int s = 0; s < steps; s++) {
+            float dx = obj.dx;
+            float dy = obj.dy;
+            if (scenario->circle) {
+                applyScreenLimitsCircle(&physics, &obj, scenario->w, scenario->h);
+            } else {
+                applyScreenLimitsRect(&physics, &obj, scenario->w, scenario->h);
+            }
+            if (dx != 0 && obj.dx == -dx) out->wall_bounces++;
+            if (dy > 0 && obj.dy < 0) out->floor_bounces++;
+            applyFriction(&physics, &obj);
+            applyGravity(&physics, &obj, scenario->gravity_h);
+            if (obj.dy == 0 && obj.y == physics.max_y) out->rested = true;
+        }
+        out->x[i] = obj.x;
+        out->y[i] = obj.y;
+    }
+    out->stopped = obj.dx == 0;
+}
+
+// RMS distance between two trajectories, over all samples
+static float rms_error(const trajectory_t* a, const trajectory_t* b)
+{
+    float sum = 0;
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        float dx = a->x[i] - b->x[i];
+        float dy = a->y[i] - b->y[i];
+        sum += dx * dx + dy * dy;
+    }
+    return sqrtf(sum / NUM_SAMPLES);
+}
+
+static int check(const scenario_t* scenario)
+{
+    static trajectory_t reference;
+    static trajectory_t run;
+    float errors[NUM_RATES];
+    int failures = 0;
+
+    simulate(scenario, REFERENCE_SIM_RATE, &reference);
+    if (reference.wall_bounces == 0 || reference.floor_bounces == 0 || !reference.stopped) {
+        fprintf(stderr, "%s: reference run does not bounce off a wall, land and stop\n", scenario->name);
+        failures++;
+    }
+    if (scenario->rests && !reference.rested) {
+        fprintf(stderr, "%s: reference run does not come to rest\n", scenario->name);
+        failures++;
+    }
+
+    printf("%s:", scenario->name);
+    for (int r = 0; r < NUM_RATES; r++) {
+        simulate(scenario, rates[r], &run);
+        errors[r] = rms_error(&run, &reference);
+        printf(" %dHz=%.2fpx", rates[r], errors[r]);
+        if (scenario->rests && !run.rested) failures++;
+        // First order integrator: the error should roughly halve when the rate doubles
+        if (r > 0) {
+            float ratio = errors[r - 1] / errors[r];
+            if (scenario->rests ? !(ratio > 1) : !(ratio >= MIN_RATIO && ratio <= MAX_RATIO)) failures++;
+        }
+    }
+    printf(" (RMS error against %dHz, %d wall / %d floor bounces)\n",
+           REFERENCE_SIM_RATE, reference.wall_bounces, reference.floor_bounces);
+    return failures;
+}
+
+int main()
+{
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        failures += check(&scenarios[i]);
+    }
+    if (failures) {
+        fprintf(stderr, "FAILED\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
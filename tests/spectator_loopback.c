@@ -0,0 +1,260 @@
+// Loopback test for the spectator stream: synthetic states are pushed through
+// the stream, flushed to a file sink, decoded back and compared with the
+// originals. Fails on excessive bandwidth or reconstruction error, or if the
+// stream does not recover from a lagging sink or a lost keyframe.
+
+#include "spectator.h"
+#include <math.h>
+#include <stdio.h>
+
+#define NUM_TICKS 3600
+#define MAX_BYTES_PER_TICK 100.0
+#define POS_TOLERANCE (0.5f / SPECTATOR_POS_SCALE + 1e-3f)
+#define VEL_TOLERANCE (0.5f / SPECTATOR_VEL_SCALE + 1e-3f)
+
+static spectator_state_t states[NUM_TICKS];
+
+static void make_state(int t, spectator_state_t *state)
+{
+    static spectator_object_t ball = { 160, 10, 480, 0 };
+    float dt = 1.0f / 60;
+
+    // Bouncing ball across the whole screen
+    ball.dy += 588.6f * dt;
+    ball.x += ball.dx * dt;
+    ball.y += ball.dy * dt;
+    if (ball.y > 465) { ball.y = 465; ball.dy = -0.95f * ball.dy; }
+    if (ball.x > 635 || ball.x < 5) ball.dx = -ball.dx;
+    state->ball = ball;
+
+    // Players running and jumping
+    for (int i = 0; i < SPECTATOR_NUM_BLOBS; i++) {
+        float phase = t * (0.05f + 0.02f * i);
+        state->blobs[i].x = 160 + 300 * i + 120 * sinf(phase);
+        state->blobs[i].y = 400 - 80 * fabsf(sinf(2 * phase));
+        state->blobs[i].dx = 360 * cosf(phase);
+        state->blobs[i].dy = -360 * cosf(2 * phase);
+    }
+
+    state->score1 = t / 400;
+    state->score2 = t / 550;
+    state->countdown = (t % 400) < 180 ? 3 - (t % 400) / 60 : 0;
+    state->last_player = (t / 90) % 2;
+    state->hit_count = (t / 30) % 3;
+}
+
+static float object_error(const spectator_object_t *a, const spectator_object_t *b, float *vel_error)
+{
+    *vel_error = fmaxf(*vel_error, fmaxf(fabsf(a->dx - b->dx), fabsf(a->dy - b->dy)));
+    return fmaxf(fabsf(a->x - b->x), fabsf(a->y - b->y));
+}
+
+// Compares a decoded state with the original one, tracking the max errors
+static bool check_state(const spectator_state_t *out, const spectator_state_t *ref, float *pos_error, float *vel_error)
+{
+    float pos = 0, vel = 0;
+    for (int i = 0; i < SPECTATOR_NUM_BLOBS; i++) {
+        pos = fmaxf(pos, object_error(&out->blobs[i], &ref->blobs[i], &vel));
+    }
+    pos = fmaxf(pos, object_error(&out->ball, &ref->ball, &vel));
+    *pos_error = fmaxf(*pos_error, pos);
+    *vel_error = fmaxf(*vel_error, vel);
+    return pos <= POS_TOLERANCE && vel <= VEL_TOLERANCE
+        && out->score1 == ref->score1 && out->score2 == ref->score2
+        && out->countdown == ref->countdown && out->last_player == ref->last_player
+        && out->hit_count == ref->hit_count;
+}
+
+// Reads one framed packet, returns its length or -1 at the end of the stream
+static int read_packet(FILE *file, uint8_t *packet)
+{
+    int len = fgetc(file);
+    if (len == EOF || fread(packet, 1, len, file) != (size_t) len) return -1;
+    return len;
+}
+
+static FILE *open_sink(spectator_sink_t *sink)
+{
+    FILE *file = tmpfile();
+    if (file == NULL) perror("tmpfile");
+    sink->write = spectator_file_write;
+    sink->ctx = file;
+    return file;
+}
+
+// Every tick is flushed a few ticks later and decoded back
+static int test_loopback()
+{
+    spectator_sink_t sink;
+    FILE *file = open_sink(&sink);
+    if (file == NULL) return 1;
+
+    spectator_stream_t stream;
+    spectator_stream_init(&stream);
+    for (int t = 0; t < NUM_TICKS; t++) {
+        spectator_push(&stream, &states[t]);
+        // The main loop runs slower than the physics timer under load
+        if (t % 3 == 0) spectator_flush(&stream, &sink);
+    }
+    spectator_flush(&stream, &sink);
+
+    long bytes = ftell(file);
+    rewind(file);
+
+    spectator_decoder_t dec;
+    spectator_decoder_init(&dec);
+    float pos_error = 0, vel_error = 0;
+    int decoded = 0, failures = 0;
+    int len;
+    uint8_t packet[256];
+    while ((len = read_packet(file, packet)) >= 0) {
+        spectator_state_t out;
+        if (decoded >= NUM_TICKS || !spectator_decode(&dec, packet, len, &out)) {
+            fprintf(stderr, "loopback: packet %d: decode failed\n", decoded);
+            failures++;
+            break;
+        }
+        if (out.seq != (uint16_t) decoded || !check_state(&out, &states[decoded], &pos_error, &vel_error)) {
+            fprintf(stderr, "loopback: packet %d: state mismatch\n", decoded);
+            failures++;
+        }
+        decoded++;
+    }
+    fclose(file);
+
+    double per_tick = (double) bytes / NUM_TICKS;
+    printf("loopback: %d ticks, %ld bytes, %.1f bytes/tick, %u dropped, max error pos=%.4f px vel=%.4f px/s\n",
+           decoded, bytes, per_tick, stream.dropped, pos_error, vel_error);
+
+    if (decoded != NUM_TICKS || stream.dropped != 0) failures++;
+    if (per_tick >= MAX_BYTES_PER_TICK) failures++;
+    return failures;
+}
+
+// The sink stalls long enough to overflow the ring: ticks are dropped, and
+// the stream must resync with a keyframe once the sink catches up
+static int test_overflow()
+{
+    spectator_sink_t sink;
+    FILE *file = open_sink(&sink);
+    if (file == NULL) return 1;
+
+    spectator_stream_t stream;
+    spectator_stream_init(&stream);
+    for (int t = 0; t < NUM_TICKS; t++) {
+        spectator_push(&stream, &states[t]);
+        if (t < 600 || t >= 800) spectator_flush(&stream, &sink);
+    }
+    spectator_flush(&stream, &sink);
+    rewind(file);
+
+    spectator_decoder_t dec;
+    spectator_decoder_init(&dec);
+    float pos_error = 0, vel_error = 0;
+    int decoded = 0, resyncs = 0, failures = 0;
+    int expected = 0;
+    int len;
+    uint8_t packet[256];
+    while ((len = read_packet(file, packet)) >= 0) {
+        spectator_state_t out;
+        if (!spectator_decode(&dec, packet, len, &out) || out.seq >= NUM_TICKS) {
+            fprintf(stderr, "overflow: packet after tick %d: decode failed\n", expected - 1);
+            failures++;
+            break;
+        }
+        if (out.seq != expected) {
+            // Ticks were dropped: the first packet after the gap must be a keyframe
+            if (!(packet[0] & SPECTATOR_FLAG_KEYFRAME)) {
+                fprintf(stderr, "overflow: tick %u: no keyframe after drop\n", out.seq);
+                failures++;
+            }
+            resyncs++;
+        }
+        if (!check_state(&out, &states[out.seq], &pos_error, &vel_error)) {
+            fprintf(stderr, "overflow: tick %u: state mismatch\n", out.seq);
+            failures++;
+        }
+        expected = out.seq + 1;
+        decoded++;
+    }
+    fclose(file);
+
+    printf("overflow: %d ticks decoded, %u dropped, %d resyncs\n", decoded, stream.dropped, resyncs);
+
+    if (stream.dropped == 0 || resyncs == 0) failures++;
+    if (decoded + stream.dropped != NUM_TICKS || expected != NUM_TICKS) failures++;
+    return failures;
+}
+
+// A keyframe is lost on the way: the deltas referencing it are rejected, and
+// decoding resumes at the next keyframe
+static int test_lost_keyframe()
+{
+    spectator_sink_t sink;
+    FILE *file = open_sink(&sink);
+    if (file == NULL) return 1;
+
+    spectator_stream_t stream;
+    spectator_stream_init(&stream);
+    for (int t = 0; t < NUM_TICKS; t++) {
+        spectator_push(&stream, &states[t]);
+        spectator_flush(&stream, &sink);
+    }
+    rewind(file);
+
+    spectator_decoder_t dec;
+    spectator_decoder_init(&dec);
+    float pos_error = 0, vel_error = 0;
+    int keyframes = 0, rejected = 0, failures = 0;
+    int resumed_at = -1;
+    int len;
+    uint8_t packet[256];
+    for (int t = 0; (len = read_packet(file, packet)) >= 0; t++) {
+        bool keyframe = packet[0] & SPECTATOR_FLAG_KEYFRAME;
+        if (keyframe && ++keyframes == 2) continue;   // Lost in transit
+
+        spectator_state_t out;
+        if (!spectator_decode(&dec, packet, len, &out)) {
+            if (keyframes != 2 || keyframe) {
+                fprintf(stderr, "lost keyframe: tick %d: unexpected decode failure\n", t);
+                failures++;
+            }
+            rejected++;
+            continue;
+        }
+        if (keyframes == 2) {
+            fprintf(stderr, "lost keyframe: tick %d: delta against lost keyframe was decoded\n", t);
+            failures++;
+        }
+        if (keyframes == 3 && resumed_at < 0) resumed_at = t;
+        if (out.seq != t || !check_state(&out, &states[t], &pos_error, &vel_error)) {
+            fprintf(stderr, "lost keyframe: tick %d: state mismatch\n", t);
+            failures++;
+        }
+    }
+    fclose(file);
+
+    printf("lost keyframe: %d deltas rejected, resumed at tick %d\n", rejected, resumed_at);
+
+    if (rejected != SPECTATOR_KEYFRAME_INTERVAL - 1) failures++;
+    if (resumed_at != 2 * SPECTATOR_KEYFRAME_INTERVAL) failures++;
+    return failures;
+}
+
+int main()
+{
+    for (int t = 0; t < NUM_TICKS; t++) {
+        make_state(t, &states[t]);
+    }
+
+    int failures = 0;
+    failures += test_loopback();
+    failures += test_overflow();
+    failures += test_lost_keyframe();
+    if (failures) {
+        fprintf(stderr, "FAILED\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Host-side decoder for the spectator stream.
+// Usage: spectate [dump...]   (reads stdin when no file is given)
+//
+// UNFLoader saves every raw binary USB message to its own file, and packets
+// may be split across messages: pass all the dumps in order, they are read
+// as one continuous stream.
+
+#include "spectator.h"
+#include <stdio.h>
+
+static char **inputs;
+static int num_inputs;
+static FILE *in;
+
+static int next_byte()
+{
+    while (1) {
+        if (in != NULL) {
+            int c = fgetc(in);
+            if (c != EOF) return c;
+            if (in != stdin) fclose(in);
+            in = NULL;
+        }
+        if (num_inputs == 0) return EOF;
+        in = fopen(*inputs, "rb");
+        if (in == NULL) perror(*inputs);
+        inputs++;
+        num_inputs--;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    inputs = argv + 1;
+    num_inputs = argc - 1;
+    if (num_inputs == 0) in = stdin;
+
+    spectator_decoder_t dec;
+    spectator_decoder_init(&dec);
+
+    uint8_t packet[256];
+    unsigned long packets = 0, keyframes = 0, skipped = 0, bytes = 0;
+    int len;
+    while ((len = next_byte()) != EOF) {
+        int n = 0;
+        int c;
+        while (n < len && (c = next_byte()) != EOF) {
+            packet[n++] = c;
+        }
+        if (n != len) {
+            fprintf(stderr, "truncated packet\n");
+            break;
+        }
+        packets++;
+        bytes += len + 1;
+        if (len == 0) {
+            skipped++;
+            continue;
+        }
+        if (packet[0] & SPECTATOR_FLAG_KEYFRAME) keyframes++;
+
+        spectator_state_t state;
+        if (!spectator_decode(&dec, packet, len, &state)) {
+            skipped++;
+            continue;
+        }
+        printf("%5u score=%d-%d countdown=%d hits=%d(P%d) ball=(%.2f,%.2f)(%.1f,%.1f)",
+               state.seq, state.score1, state.score2, state.countdown,
+               state.hit_count, state.last_player,
+               state.ball.x, state.ball.y, state.ball.dx, state.ball.dy);
+        for (int i = 0; i < SPECTATOR_NUM_BLOBS; i++) {
+            printf(" p%d=(%.2f,%.2f)(%.1f,%.1f)", i + 1,
+                   state.blobs[i].x, state.blobs[i].y, state.blobs[i].dx, state.blobs[i].dy);
+        }
+        printf("\n");
+    }
+
+    fprintf(stderr, "%lu packets (%lu keyframes, %lu undecodable), %lu bytes, %.1f bytes/tick\n",
+            packets, keyframes, skipped, bytes, packets ? (double) bytes / packets : 0.0);
+
+    if (in != NULL && in != stdin) fclose(in);
+    return 0;
+}